@@ -0,0 +1,280 @@
+// throughput benchmark for the cooperative planner
+//
+// usage: a-star-mapf-bench [agent count] [map size] [window size]
+//
+// generates a square map with random obstacles, gives every agent a random start
+// and goal and moves the agents until all of them have reached their goals.
+// The routes are replanned half way through each window
+//
+// the executed routes are checked for agents ending up on the same tile or
+// swapping places. The program returns a non-zero exit code if any are found,
+// if the planner reports conflicts, if the agents don't reach their goals or
+// if the planner allocates from the heap after the first window
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <random>
+#include <vector>
+
+#include "CooperativePlanner.hpp"
+
+// count the heap allocations, so that we can see if the planner
+// allocates anything after it has warmed up
+static std::atomic<size_t> allocation_count{0};
+
+void* operator new(std::size_t size)
+{
+	++allocation_count;
+
+	if (void* ptr = std::malloc(size ? size : 1))
+		return ptr;
+
+	throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	++allocation_count;
+
+	// aligned_alloc wants the size to be a multiple of the alignment
+	const size_t align = static_cast<size_t>(alignment);
+	if (void* ptr = std::aligned_alloc(align, (size + align - 1) / align * align))
+		return ptr;
+
+	throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) { return operator new(size); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return operator new(size, alignment); }
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+
+// find the tiles that can be reached from the given tile
+// the agents get placed only on these tiles, so that all of the goals can be reached
+static std::vector<u32> find_reachable_tiles(const std::vector<tile_state>& walls, const u16 map_size, const u32 first_tile)
+{
+	std::vector<bool> visited(walls.size(), false);
+	std::vector<u32> reachable = { first_tile };
+	visited[first_tile] = true;
+
+	for (size_t i = 0; i < reachable.size(); ++i)
+	{
+		const i32 x = reachable[i] % map_size;
+		const i32 y = reachable[i] / map_size;
+
+		// same 8-neighborhood as the planner uses
+		for (i32 dx = -1; dx < 2; ++dx)
+		{
+			for (i32 dy = -1; dy < 2; ++dy)
+			{
+				const i32 nx = x + dx;
+				const i32 ny = y + dy;
+
+				if (nx < 0 || ny < 0 || nx >= map_size || ny >= map_size)
+					continue;
+
+				const u32 neighbor = ny * map_size + nx;
+				if (visited[neighbor] || walls[neighbor] == tile_state::obstacle)
+					continue;
+
+				visited[neighbor] = true;
+				reachable.push_back(neighbor);
+			}
+		}
+	}
+
+	return reachable;
+}
+
+// the peak resident memory of the process in kilobytes
+// reads VmHWM from /proc, so this only works on Linux. Returns 0 if it couldn't be read
+static size_t read_peak_memory_kb()
+{
+	std::FILE* status = std::fopen("/proc/self/status", "r");
+	if (!status)
+		return 0;
+
+	size_t peak_kb{0};
+	char line[256];
+
+	while (std::fgets(line, sizeof(line), status))
+	{
+		if (std::strncmp(line, "VmHWM:", 6) == 0)
+		{
+			std::sscanf(line + 6, "%zu", &peak_kb);
+			break;
+		}
+	}
+
+	std::fclose(status);
+	return peak_kb;
+}
+
+int main(int argc, char** argv)
+{
+	const u32 agent_count = argc > 1 ? std::atoi(argv[1]) : 1000;
+	const u16 map_size = argc > 2 ? std::atoi(argv[2]) : 512;
+	const u16 window_size = argc > 3 ? std::atoi(argv[3]) : 16;
+	const u16 replan_interval = std::max(window_size / 2, 1);
+
+	// give up if the agents haven't made it by then
+	const u32 max_time = map_size * 20;
+
+	// generate the map with a fixed seed, so that the runs are comparable
+	constexpr u8 obstacle_percentage = 20;
+	std::mt19937 rng(42);
+
+	std::vector<tile_state> walls(map_size * map_size, tile_state::unexplored);
+	for (tile_state& wall : walls)
+		if (rng() % 100 < obstacle_percentage)
+			wall = tile_state::obstacle;
+
+	// make sure that the center tile is free and place the agents to the area reachable from it
+	const u32 center_tile = (map_size / 2) * map_size + map_size / 2;
+	walls[center_tile] = tile_state::unexplored;
+
+	std::vector<u32> free_tiles = find_reachable_tiles(walls, map_size, center_tile);
+	if (free_tiles.size() < agent_count * 2)
+	{
+		std::fprintf(stderr, "the map is too small for %u agents\n", agent_count);
+		return 1;
+	}
+
+	// each agent gets a start and goal of its own
+	std::shuffle(free_tiles.begin(), free_tiles.end(), rng);
+
+	cooperative_planner planner(walls, map_size, map_size, window_size, agent_count);
+
+	const auto to_coordinates = [&](const u32 tile_index)
+	{
+		return birb::vec2<i16>(tile_index % map_size, tile_index / map_size);
+	};
+
+	for (u32 i = 0; i < agent_count; ++i)
+		planner.add_agent(to_coordinates(free_tiles[i]), to_coordinates(free_tiles[agent_count + i]));
+
+	// which agent was at each tile on the previous and on the current step
+	// only the tiles that have agents on them get cleared between the steps
+	constexpr u32 no_agent = std::numeric_limits<u32>::max();
+	std::vector<u32> previous_owner(walls.size(), no_agent);
+	std::vector<u32> current_owner(walls.size(), no_agent);
+	std::vector<u32> previous_positions(agent_count);
+	std::vector<u32> current_positions(agent_count);
+
+	const auto tile_index = [&](const birb::vec2<i16> coordinates) -> u32
+	{
+		return coordinates.y * map_size + coordinates.x;
+	};
+
+	for (u32 i = 0; i < agent_count; ++i)
+	{
+		previous_positions[i] = tile_index(planner.agent_position(i));
+		previous_owner[previous_positions[i]] = i;
+	}
+
+	using clock = std::chrono::steady_clock;
+
+	f64 first_window_time{0};
+	f64 window_time_sum{0};
+	u32 window_count{0};
+	size_t steady_allocations{0};
+
+	u32 failed_plans{0};
+	u32 reservation_conflicts{0};
+	u32 vertex_collisions{0};
+	u32 swaps{0};
+
+	while (!planner.all_agents_at_goal() && planner.current_time() < max_time)
+	{
+		const size_t allocations_before = allocation_count;
+		const clock::time_point start = clock::now();
+
+		planner.plan_window();
+
+		const f64 window_time = std::chrono::duration<f64, std::milli>(clock::now() - start).count();
+
+		// the first window fills the true distance caches, so its kept separate
+		if (window_count == 0)
+			first_window_time = window_time;
+		else
+		{
+			window_time_sum += window_time;
+			steady_allocations += allocation_count - allocations_before;
+		}
+
+		++window_count;
+		failed_plans += planner.failed_plan_count();
+		reservation_conflicts += planner.reservation_conflict_count();
+
+		// walk the agents along the planned routes and check every step for collisions
+		for (u16 step = 1; step <= replan_interval; ++step)
+		{
+			for (u32 i = 0; i < agent_count; ++i)
+			{
+				const auto& route = planner.planned_route(i);
+				current_positions[i] = tile_index(route[std::min<size_t>(step, route.size() - 1)]);
+
+				// two agents on the same tile
+				if (current_owner[current_positions[i]] != no_agent)
+					++vertex_collisions;
+
+				current_owner[current_positions[i]] = i;
+			}
+
+			// two agents going through each other
+			for (u32 i = 0; i < agent_count; ++i)
+			{
+				const u32 other = previous_owner[current_positions[i]];
+				if (other != no_agent && other != i && current_positions[other] == previous_positions[i])
+					++swaps;
+			}
+
+			// the current step becomes the previous step
+			for (u32 i = 0; i < agent_count; ++i)
+				previous_owner[previous_positions[i]] = no_agent;
+
+			std::swap(previous_owner, current_owner);
+			std::swap(previous_positions, current_positions);
+		}
+
+		planner.step(replan_interval);
+	}
+
+	// each swap gets found from both agents
+	swaps /= 2;
+
+	const u32 steady_windows = window_count - 1;
+	const f64 average_window_time = steady_windows ? window_time_sum / steady_windows : 0;
+
+	std::printf("agents: %u, map: %ux%u, window: %u, replan interval: %u\n", agent_count, map_size, map_size, window_size, replan_interval);
+	std::printf("time steps: %u, windows: %u, all at goal: %s\n", planner.current_time(), window_count, planner.all_agents_at_goal() ? "yes" : "no");
+	std::printf("first window: %.1f ms, average window after that: %.2f ms (%.0f agent plans/s)\n",
+			first_window_time, average_window_time, average_window_time > 0 ? agent_count / (average_window_time / 1000) : 0);
+	std::printf("heap allocations after the first window: %zu\n", steady_allocations);
+
+	if (const size_t peak_kb = read_peak_memory_kb())
+		std::printf("peak memory: %.1f MiB\n", peak_kb / 1024.0);
+	std::printf("reverse search expansions: %zu\n", planner.heuristic_expansion_count());
+	std::printf("failed plans: %u, reservation conflicts: %u, vertex collisions: %u, swaps: %u\n",
+			failed_plans, reservation_conflicts, vertex_collisions, swaps);
+
+	const bool ok = planner.all_agents_at_goal()
+		&& reservation_conflicts == 0
+		&& vertex_collisions == 0
+		&& swaps == 0
+		&& steady_allocations == 0;
+	return ok ? 0 : 1;
+}
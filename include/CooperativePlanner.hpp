@@ -0,0 +1,211 @@
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <functional>
+#include <memory_resource>
+#include <unordered_map>
+#include <vector>
+
+#include "Assert.hpp"
+#include "ReservationTable.hpp"
+#include "Tile.hpp"
+
+// cooperative pathfinding for multiple agents on the same tile grid (WHCA*)
+//
+// the agents plan their routes one after another in space-time. Each agent
+// reserves the tiles along its route in a shared reservation table and the
+// agents after it will route around those reservations (or wait for them to clear)
+//
+// the routes are only planned a limited amount of time steps (the window) ahead.
+// Past the window the true distance to the goal is used as the heuristic. The true
+// distances are calculated with a reverse search from each goal that gets cached
+// and resumed when a distance for a new tile is needed
+class cooperative_planner
+{
+public:
+	// walls is a row-major list of tile states with the same meaning as in the game
+	// (obstacles are the only tiles that can't be walked on)
+	cooperative_planner(const std::vector<tile_state>& walls, const u16 width, const u16 height,
+			const u16 window_size, const size_t max_agents);
+
+	// add a new agent and get its id
+	// the start and goal tiles need to be inside of the grid and they can't be obstacles.
+	// Each agent needs to have a goal of its own
+	u32 add_agent(const birb::vec2<i16> start, const birb::vec2<i16> goal);
+
+	// plan the next window for all agents against a fresh reservation table
+	// the planning order gets rotated on each call so that the same agents
+	// don't always get the priority
+	void plan_window();
+
+	// move all agents forward along their planned routes
+	// the step count should be at most the window size. Usually the routes
+	// are replanned half way through the window
+	void step(const u16 steps);
+
+	// the route planned for the agent in the last plan_window() call
+	// the first tile is where the agent was at the time of planning
+	const std::pmr::vector<birb::vec2<i16>>& planned_route(const u32 agent) const;
+
+	birb::vec2<i16> agent_position(const u32 agent) const;
+	bool all_agents_at_goal() const;
+
+	// the time step that the agents are currently at
+	u32 current_time() const;
+
+	// amount of agents that couldn't find a route in the last plan_window() call
+	// and stayed in place instead
+	u32 failed_plan_count() const;
+
+	// amount of (tile, time step) reservations in the last plan_window() call that
+	// overlapped with another agent. Happens when agents start on the same tile or
+	// when an agent that couldn't find a route has to wait on a reserved tile
+	u32 reservation_conflict_count() const;
+
+	// amount of tiles the reverse searches have expanded in total
+	size_t heuristic_expansion_count() const;
+
+	// the cost of moving to a neighboring tile (or waiting in place for a step)
+	// these match the world scale used by the game state
+	static constexpr u16 straight_cost = 10;
+	static constexpr u16 diagonal_cost = 14;
+
+private:
+	// (f_cost, tile index or node index) pairs in the open list heaps
+	using open_node = std::pair<u32, u32>;
+
+	// the reverse searches store their distances in square chunks of tiles.
+	// A reverse search only covers the area between the goal and the agent,
+	// so the chunks get allocated when the search first reaches them
+	static constexpr u8 chunk_size = 16;
+	static constexpr u16 chunk_tile_count = chunk_size * chunk_size;
+
+	struct distance_chunk
+	{
+		std::array<u16, chunk_tile_count> distance;
+
+		// the distance of a tile is final when it has been closed
+		std::bitset<chunk_tile_count> closed;
+	};
+
+	// resumable reverse search from a goal tile (RRA*)
+	struct true_distance
+	{
+		explicit true_distance(std::pmr::memory_resource* memory)
+		:chunks(memory), open(memory) {}
+
+		// the tile the distances are measured to
+		u32 goal;
+
+		// the start tile of the agent heading to the goal
+		// the reverse search is guided towards it with the octile distance
+		u32 target;
+
+		// one slot for each chunk of the grid, nullptr until the search reaches the chunk
+		std::pmr::vector<distance_chunk*> chunks;
+
+		// binary min-heap of (f_cost, tile index) pairs
+		// the heap grows whenever the search gets resumed, so it takes its memory
+		// from the planner's pool, where the blocks freed by the other heaps can be reused
+		std::pmr::vector<open_node> open;
+	};
+
+	struct agent
+	{
+		u32 position;
+		u32 goal;
+
+		// the cached true distances to the goal of the agent
+		// unordered_map never moves its elements, so the pointer stays valid
+		true_distance* distances;
+
+		// the tiles that the agent will be at on each step of the window
+		std::pmr::vector<birb::vec2<i16>> route;
+	};
+
+	// a node in the space-time search
+	struct search_node
+	{
+		u32 tile_index;
+		u16 time_offset;
+		u32 g_cost;
+		u32 predecessor;
+	};
+
+	const std::pmr::vector<tile*>& get_tile_neighbors(const u32 index);
+	u16 move_cost(const u32 from, const u32 to) const;
+	u16 octile_distance(const u32 from, const u32 to) const;
+
+	// true distance from the tile to the goal, calculated on demand
+	// unreachable tiles get the maximum distance
+	u16 heuristic(true_distance& distances, const u32 index);
+
+	// get the distance chunk that has the tile in it, allocating it if needed
+	distance_chunk& get_chunk(true_distance& distances, const u32 index);
+	bool is_closed(const true_distance& distances, const u32 index) const;
+	u32 chunk_index(const u32 index) const;
+	u16 index_in_chunk(const u32 index) const;
+
+	// plan the route of a single agent and reserve it
+	// returns false if no route was found within the window
+	bool plan_agent(const u32 agent_id);
+
+	// make the agent wait in place for the window, reserving the tiles where possible
+	void plan_wait(const u32 agent_id);
+
+	bool is_in_bounds(const birb::vec2<i16> coordinates) const;
+	u32 tile_index(const birb::vec2<i16> coordinates) const;
+
+	// push and pop for the open list heap of the space-time search
+	void push_open_node(const u32 f_cost, const u32 node_index);
+	u32 pop_open_node();
+
+	const u16 width;
+	const u16 height;
+	const u16 window_size;
+	const size_t max_agents;
+
+	// how many distance chunks there are on each row of the grid
+	const u16 chunks_per_row;
+
+	// memory for the space-time searches and the agent routes. The pool keeps
+	// the memory that gets freed and hands it out again, so once the containers
+	// have grown to the size they need, planning doesn't allocate from the heap
+	//
+	// this needs to be declared before the agents and the search containers
+	// so that it outlives them
+	std::pmr::unsynchronized_pool_resource search_memory;
+
+	std::vector<tile> tiles;
+	std::vector<agent> agents;
+
+	reservation_table reservations;
+
+	// cached reverse searches, one per goal tile (and thus one per agent)
+	std::unordered_map<u32, true_distance> true_distances;
+
+	u32 time{0};
+	u32 planning_offset{0};
+	u32 failed_plans{0};
+	u32 reservation_conflicts{0};
+	size_t heuristic_expansions{0};
+
+	// space-time search state, cleared before each agent gets planned
+	//
+	// all of the nodes created during the search. The open list
+	// refers to the nodes with their index in this list
+	std::pmr::vector<search_node> search_nodes{&search_memory};
+
+	// the lowest g_cost found so far for each (tile, time offset) pair
+	std::pmr::unordered_map<u64, u32> best_g_costs{&search_memory};
+
+	// binary min-heap of (f_cost, node index) pairs
+	std::pmr::vector<open_node> open_list{&search_memory};
+
+	// scratch buffer that get_tile_neighbors() fills
+	// the 8 surrounding tiles and the tile itself (waiting in place)
+	static constexpr u8 max_neighbor_count = 9;
+	std::pmr::vector<tile*> neighbor_scratch;
+};
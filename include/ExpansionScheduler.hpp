@@ -0,0 +1,64 @@
+#pragma once
+
+#include <chrono>
+
+#include "Timestep.hpp"
+
+// decides how many A* iterations (tile expansions) get run on each frame
+class expansion_scheduler
+{
+public:
+	// the scheduler starts in adaptive mode. The frame times come from the timestep
+	// and the target frame time caps the expansion budget on slow machines
+	expansion_scheduler(const birb::timestep& timestep, const f64 target_frame_time);
+
+	// switch to running a set amount of expansions per frame
+	void use_fixed_batch(const u32 expansions_per_frame);
+
+	// get the amount of expansions that should be run on this frame
+	// call batch_finished() right after running them with the amount of
+	// expansions that were run, so that the scheduler knows how long they took
+	u32 next_batch();
+	void batch_finished(const u32 expansions_run);
+
+private:
+	enum class mode : u8
+	{
+		// fit the batch into a fraction of the frame time
+		adaptive = 0,
+
+		// run the same amount of expansions on every frame
+		// useful for reproducible recordings
+		fixed = 1
+	};
+
+	const birb::timestep& timestep;
+
+	mode scheduling_mode = mode::adaptive;
+
+	// the longest frame time that the expansion budget is based on
+	// caps the budget if the frames are slower than this
+	f64 target_frame_time;
+
+	// exponential moving averages of the recent frame times
+	// and the time it took to run a single expansion
+	f64 smoothed_frame_time;
+
+	// zero until the first batch has been measured
+	f64 smoothed_expansion_time{0};
+
+	// when the current batch was handed out
+	std::chrono::steady_clock::time_point batch_start;
+
+	// how much of the frame can be spent on running the expansions
+	// the rest is left for rendering and the rest of the main loop
+	static constexpr f64 expansion_budget = 0.5;
+
+	// how much weight the latest measurement has in the averages
+	static constexpr f64 smoothing = 0.25;
+
+	static constexpr u32 min_batch_size = 1;
+	static constexpr u32 max_batch_size = 1 << 20;
+
+	u32 batch = min_batch_size;
+};
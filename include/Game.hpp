@@ -2,8 +2,11 @@
 
 #include <array>
 #include <cmath>
+#include <cstddef>
 #include <memory>
+#include <memory_resource>
 #include <unordered_set>
+#include <vector>
 
 #include "Random.hpp"
 #include "Scene.hpp"
@@ -22,14 +25,21 @@ public:
 	// the scene that'll hold all of the game objects
 	birb::scene scene;
 
-	void update();
+	// run up to expansion_count iterations of the A* loop and refresh the visuals
+	// returns the amount of iterations that were run, which is less than
+	// expansion_count if the goal was reached in the middle of the batch
+	u32 update(const u32 expansion_count = 1);
 	void reset();
 	bool is_done() const;
 
 private:
 	void generate_map();
-	std::vector<tile*> get_tile_neighbors(const birb::vec2<i16> tile_to_check);
+	void expand_next_tile();
+	void update_tile_visuals();
+	void show_route();
+	const std::pmr::vector<tile*>& get_tile_neighbors(const birb::vec2<i16> tile_to_check);
 	void update_weight_texts();
+	void reset_search_memory();
 
 	static constexpr u8 map_size = 16;
 	std::array<std::array<u8, map_size>, map_size> walls = {
@@ -64,6 +74,9 @@ private:
 
 	std::array<std::array<tile*, map_size>, map_size> tiles = {nullptr};
 
+	// the cost texts have room for 3 digits, so bigger costs are shown as 999
+	static constexpr u16 max_displayed_cost = 999;
+
 	// text rows for displaying the g-cost
 	std::array<birb::text*, map_size> weight_text_rows = {nullptr};
 	std::array<std::string, map_size> weight_text_row_strings;
@@ -72,8 +85,25 @@ private:
 	std::array<birb::text*, map_size> f_and_h_cost_text_rows;
 	std::array<std::string, map_size> f_and_h_cost_text_row_strings;
 
-	std::unordered_set<tile*> open_set;
-	std::unordered_set<tile*> closed_set;
+	// arena for all of the memory used during a single search (open and closed sets,
+	// neighbor lists etc.). The arena gets rewound when the map is reset, so after
+	// the first search the pathfinding itself doesn't allocate from the heap.
+	// Updating the text entities still does, see update_weight_texts()
+	//
+	// the size is a rough upper bound of what the sets need on a map_size x map_size map
+	// (a node and a bucket per tile for both of the sets). If it ever runs out, the
+	// arena falls back to the default heap allocator
+	static constexpr size_t search_arena_size = map_size * map_size * 128 + 4096;
+	alignas(std::max_align_t) std::array<std::byte, search_arena_size> search_arena_buffer;
+	std::pmr::monotonic_buffer_resource search_arena{search_arena_buffer.data(), search_arena_buffer.size()};
+
+	std::pmr::unordered_set<tile*> open_set{&search_arena};
+	std::pmr::unordered_set<tile*> closed_set{&search_arena};
+
+	// scratch buffer that get_tile_neighbors() fills in place of returning a new vector
+	// a tile can have at most 8 neighbors
+	static constexpr u8 max_neighbor_count = 8;
+	std::pmr::vector<tile*> neighbor_scratch{&search_arena};
 
 	// these need to be found at the initialization phase
 	birb::vec2<i16> start_location;
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <limits>
+#include <memory>
+
+#include "Vector.hpp"
+
+// space-time reservation table used in cooperative pathfinding
+//
+// maps (tile, time step) pairs to the agent that has reserved that tile at that
+// point in time. The table is an open addressing hash table with linear probing
+// and a fixed capacity, so inserting reservations never allocates
+//
+// any amount of threads can read the table while a single thread is
+// writing reservations into it. clear() shouldn't be called while reading
+class reservation_table
+{
+public:
+	// returned by reserved_by() when the tile is free at the given time
+	static constexpr u32 no_agent = std::numeric_limits<u32>::max();
+
+	// the tile indices are packed into the keys with this many bits,
+	// so the grid can't have more tiles than this
+	static constexpr u8 tile_bits = 24;
+	static constexpr size_t max_tile_count = size_t(1) << tile_bits;
+
+	// the table gets sized to hold at least max_reservations entries
+	// while keeping the load factor at or below 50%
+	explicit reservation_table(const size_t max_reservations);
+
+	// try to reserve a tile for an agent at the given time step
+	// returns false if another agent has already reserved the tile at that time
+	// or if the table is full. Reserving the same tile twice for the same agent is fine
+	bool reserve(const u32 tile_index, const u32 time, const u32 agent);
+
+	// get the agent that has reserved the tile at the given time
+	// returns no_agent if the tile is free
+	u32 reserved_by(const u32 tile_index, const u32 time) const;
+
+	// drop all of the reservations
+	// this only bumps the generation counter, so its O(1) apart from
+	// the rare case where the counter wraps around
+	void clear();
+
+private:
+	// a key packs the generation, time step and the tile index into a single word
+	// so that it can be read and written atomically
+	//
+	// | generation (16 bits) | time (24 bits) | tile index (24 bits) |
+	//
+	// keys from older generations are treated as empty slots
+	static constexpr u8 time_bits = 24;
+
+	u64 make_key(const u32 tile_index, const u32 time) const;
+	size_t slot_index(const u64 key) const;
+
+	struct slot
+	{
+		std::atomic<u64> key{0};
+		std::atomic<u32> agent{no_agent};
+	};
+
+	std::unique_ptr<slot[]> slots;
+	size_t capacity;
+
+	// generation zero is reserved for never-written slots
+	u16 generation{1};
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <memory_resource>
+#include <vector>
+
+#include "Tile.hpp"
+
+// fill the neighbor list with the tiles around tile_to_check that can be walked to
+//
+// get_tile takes tile coordinates and returns a pointer to the tile at those coordinates
+// the grid is grid_size.x tiles wide and grid_size.y tiles tall
+//
+// if include_self is true, the tile itself is also added to the list
+// (for searches where waiting in place is allowed)
+template<typename tile_getter>
+void find_tile_neighbors(const birb::vec2<i16> tile_to_check, const birb::vec2<i16> grid_size,
+		const tile_getter& get_tile, const bool include_self, std::pmr::vector<tile*>& neighbors)
+{
+	// a lambda that checks if a tile is an explorable neighbor or not
+	// a not-explorable tile would be a tile out-of-bounds or an obstacle
+	const auto is_explorable_tile = [&](const birb::vec2<i16> tile_coords) -> bool
+	{
+		// check if the tile is within the bounds of the area we are exploring
+		if (tile_coords.x < 0 || tile_coords.y < 0)
+			return false;
+
+		if (tile_coords.x >= grid_size.x || tile_coords.y >= grid_size.y)
+			return false;
+
+		// check if the tile is an obstacle
+		if (get_tile(tile_coords)->state == tile_state::obstacle)
+			return false;
+
+		return true;
+	};
+
+	// the list is expected to have its capacity reserved already,
+	// so clearing and refilling it shouldn't allocate
+	neighbors.clear();
+
+	// loop through a 3x3 grid around the tile we are checking
+	for (i8 i = -1; i < 2; ++i)
+	{
+		for (i8 j = -1; j < 2; ++j)
+		{
+			// skip the current tile (that we are checking) unless waiting is allowed
+			// we are at the current tile when i and j are 0
+			if (!i && !j && !include_self) continue;
+
+			// check if the tile is explorable (i.e. in the bounds and not an obstacle)
+			// if it is, add it to the neighbor list
+			const birb::vec2<i16> neighbor(tile_to_check.x - i, tile_to_check.y - j);
+
+			if (is_explorable_tile(neighbor))
+				neighbors.emplace_back(get_tile(neighbor));
+		}
+	}
+}
@@ -0,0 +1,448 @@
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <limits>
+
+#include "CooperativePlanner.hpp"
+#include "TileGrid.hpp"
+
+// marks unknown and unreachable distances in the reverse searches
+static constexpr u16 unknown_distance = std::numeric_limits<u16>::max();
+
+// marks the first node of a space-time search (it has no predecessor)
+static constexpr u32 no_node = std::numeric_limits<u32>::max();
+
+cooperative_planner::cooperative_planner(const std::vector<tile_state>& walls, const u16 width, const u16 height,
+		const u16 window_size, const size_t max_agents)
+:width(width), height(height), window_size(window_size), max_agents(max_agents),
+	chunks_per_row((width + chunk_size - 1) / chunk_size), reservations(max_agents * (window_size + 1))
+{
+	// the tile coordinates are stored as i16 and the tile indices need to
+	// fit into the reservation table keys
+	const size_t tile_count = static_cast<size_t>(width) * height;
+	birb::ensure(width <= std::numeric_limits<i16>::max() && height <= std::numeric_limits<i16>::max(), "the grid is too wide or tall for i16 tile coordinates");
+	birb::ensure(tile_count <= reservation_table::max_tile_count, "the grid has too many tiles for the reservation table");
+	birb::ensure(walls.size() == tile_count, "the wall list doesn't match the grid size");
+
+	// create the tile grid the same way the game state does,
+	// just without the entities since nothing gets rendered here
+	tiles.resize(tile_count);
+
+	for (u16 i = 0; i < width; ++i)
+	{
+		for (u16 j = 0; j < height; ++j)
+		{
+			const size_t index = static_cast<size_t>(j) * width + i;
+
+			tile& t = tiles[index];
+			t.position = birb::vec2<i16>(i * straight_cost, j * straight_cost);
+			t.coordinates = birb::vec2<i16>(i, j);
+			t.state = walls[index];
+		}
+	}
+
+	agents.reserve(max_agents);
+	neighbor_scratch.reserve(max_neighbor_count);
+}
+
+u32 cooperative_planner::add_agent(const birb::vec2<i16> start, const birb::vec2<i16> goal)
+{
+	// the reservation table has been sized for max_agents
+	birb::ensure(agents.size() < max_agents, "the planner is already full of agents");
+
+	// the tile lookups aren't bounds checked, so invalid coordinates need to be caught here
+	birb::ensure(is_in_bounds(start), "the start tile is outside of the grid");
+	birb::ensure(is_in_bounds(goal), "the goal tile is outside of the grid");
+
+	const u32 start_index = tile_index(start);
+	const u32 goal_index = tile_index(goal);
+
+	birb::ensure(tiles[start_index].state != tile_state::obstacle, "the start tile can't be an obstacle");
+	birb::ensure(tiles[goal_index].state != tile_state::obstacle, "the goal tile can't be an obstacle");
+
+	// each goal can only have a single agent. Waiting at the goal is free, so the
+	// first agent to arrive would park there and block the others forever
+	const auto [it, inserted] = true_distances.try_emplace(goal_index, &search_memory);
+	birb::ensure(inserted, "another agent already has the same goal");
+
+	// start the reverse search from the goal towards the agent
+	{
+		true_distance& d = it->second;
+		d.goal = goal_index;
+		d.target = start_index;
+
+		const u32 chunk_rows = (height + chunk_size - 1) / chunk_size;
+		d.chunks.assign(chunks_per_row * chunk_rows, nullptr);
+
+		get_chunk(d, goal_index).distance[index_in_chunk(goal_index)] = 0;
+		d.open.push_back({ octile_distance(goal_index, start_index), goal_index });
+	}
+
+	agents.push_back({ start_index, goal_index, &it->second, std::pmr::vector<birb::vec2<i16>>(&search_memory) });
+	agents.back().route.reserve(window_size + 1);
+
+	return agents.size() - 1;
+}
+
+void cooperative_planner::plan_window()
+{
+	// forget the previous window
+	reservations.clear();
+	failed_plans = 0;
+	reservation_conflicts = 0;
+
+	// the routes keep their capacity, so replanning them doesn't allocate
+	for (agent& a : agents)
+		a.route.clear();
+
+	if (agents.empty())
+		return;
+
+	// reserve the current positions of all agents first, so that the agents
+	// planned early don't try to walk through the agents planned after them
+	// two agents on the same tile is a conflict that can't be planned around anymore
+	for (size_t i = 0; i < agents.size(); ++i)
+		if (!reservations.reserve(agents[i].position, time, i))
+			++reservation_conflicts;
+
+	// plan the agents one by one. Each agent avoids the reservations
+	// of the agents planned before it
+	for (size_t i = 0; i < agents.size(); ++i)
+	{
+		const u32 agent_id = (i + planning_offset) % agents.size();
+
+		if (!plan_agent(agent_id))
+		{
+			++failed_plans;
+			plan_wait(agent_id);
+		}
+	}
+
+	// give the priority to the next agent on the next window
+	planning_offset = (planning_offset + 1) % agents.size();
+}
+
+void cooperative_planner::step(const u16 steps)
+{
+	for (agent& a : agents)
+	{
+		// the agent hasn't been planned yet
+		if (a.route.empty())
+			continue;
+
+		// the route doesn't go further than the window, so the
+		// agent stays at the end of it if we step past the window
+		const size_t route_step = std::min<size_t>(steps, a.route.size() - 1);
+		a.position = tile_index(a.route[route_step]);
+	}
+
+	time += steps;
+}
+
+const std::pmr::vector<birb::vec2<i16>>& cooperative_planner::planned_route(const u32 agent) const
+{
+	return agents.at(agent).route;
+}
+
+birb::vec2<i16> cooperative_planner::agent_position(const u32 agent) const
+{
+	return tiles[agents.at(agent).position].coordinates;
+}
+
+bool cooperative_planner::all_agents_at_goal() const
+{
+	return std::all_of(agents.begin(), agents.end(), [](const agent& a) { return a.position == a.goal; });
+}
+
+u32 cooperative_planner::current_time() const
+{
+	return time;
+}
+
+u32 cooperative_planner::failed_plan_count() const
+{
+	return failed_plans;
+}
+
+u32 cooperative_planner::reservation_conflict_count() const
+{
+	return reservation_conflicts;
+}
+
+size_t cooperative_planner::heuristic_expansion_count() const
+{
+	return heuristic_expansions;
+}
+
+const std::pmr::vector<tile*>& cooperative_planner::get_tile_neighbors(const u32 index)
+{
+	// the tiles are stored in a row-major list
+	const auto get_tile = [&](const birb::vec2<i16> tile_coords) -> tile*
+	{
+		return &tiles[tile_index(tile_coords)];
+	};
+
+	// the tile itself is included since the agents can wait in place
+	find_tile_neighbors(tiles[index].coordinates, birb::vec2<i16>(width, height), get_tile, true, neighbor_scratch);
+
+	return neighbor_scratch;
+}
+
+u16 cooperative_planner::move_cost(const u32 from, const u32 to) const
+{
+	const birb::vec2<i16> a = tiles[from].coordinates;
+	const birb::vec2<i16> b = tiles[to].coordinates;
+
+	// waiting in place costs as much as a straight move
+	return (a.x != b.x && a.y != b.y) ? diagonal_cost : straight_cost;
+}
+
+u16 cooperative_planner::octile_distance(const u32 from, const u32 to) const
+{
+	const birb::vec2<i16> a = tiles[from].coordinates;
+	const birb::vec2<i16> b = tiles[to].coordinates;
+
+	const u32 dx = std::abs(a.x - b.x);
+	const u32 dy = std::abs(a.y - b.y);
+
+	// move diagonally as far as possible and go straight for the rest of the way
+	const u32 distance = std::min(dx, dy) * diagonal_cost + (std::max(dx, dy) - std::min(dx, dy)) * straight_cost;
+	return std::min<u32>(distance, unknown_distance - 1);
+}
+
+u16 cooperative_planner::heuristic(true_distance& d, const u32 index)
+{
+	// resume the reverse search until the tile we want the distance for gets closed
+	// the octile distance is consistent, so the distances of closed tiles are final
+	while (!is_closed(d, index))
+	{
+		// the whole area reachable from the goal has been searched
+		// and the tile wasn't found, so the goal can't be reached from it
+		if (d.open.empty())
+			return unknown_distance;
+
+		// the open list is a min-heap, move the lowest f_cost to the back and take it from there
+		std::pop_heap(d.open.begin(), d.open.end(), std::greater<open_node>());
+		const u32 current = d.open.back().second;
+		d.open.pop_back();
+
+		distance_chunk& current_chunk = get_chunk(d, current);
+		const u16 current_offset = index_in_chunk(current);
+
+		// skip duplicates, the tile could have been pushed multiple times
+		if (current_chunk.closed[current_offset])
+			continue;
+
+		current_chunk.closed[current_offset] = true;
+		++heuristic_expansions;
+
+		for (tile* const t : get_tile_neighbors(current))
+		{
+			const u32 neighbor = tile_index(t->coordinates);
+
+			distance_chunk& neighbor_chunk = get_chunk(d, neighbor);
+			const u16 neighbor_offset = index_in_chunk(neighbor);
+
+			if (neighbor_chunk.closed[neighbor_offset])
+				continue;
+
+			// the distances saturate below the unknown marker. Saturated distances are
+			// still lower than the real ones, so the heuristic stays admissible
+			const u32 new_distance = std::min<u32>(current_chunk.distance[current_offset] + move_cost(current, neighbor), unknown_distance - 1);
+
+			if (new_distance < neighbor_chunk.distance[neighbor_offset])
+			{
+				neighbor_chunk.distance[neighbor_offset] = new_distance;
+				d.open.push_back({ new_distance + octile_distance(neighbor, d.target), neighbor });
+				std::push_heap(d.open.begin(), d.open.end(), std::greater<open_node>());
+			}
+		}
+	}
+
+	return get_chunk(d, index).distance[index_in_chunk(index)];
+}
+
+cooperative_planner::distance_chunk& cooperative_planner::get_chunk(true_distance& d, const u32 index)
+{
+	distance_chunk*& chunk = d.chunks[chunk_index(index)];
+
+	// the chunks come from the pool and they stay around as long as the planner does
+	if (!chunk)
+	{
+		chunk = std::pmr::polymorphic_allocator<distance_chunk>(&search_memory).new_object<distance_chunk>();
+		chunk->distance.fill(unknown_distance);
+	}
+
+	return *chunk;
+}
+
+bool cooperative_planner::is_closed(const true_distance& d, const u32 index) const
+{
+	// tiles in chunks that haven't been allocated haven't been reached yet
+	const distance_chunk* const chunk = d.chunks[chunk_index(index)];
+	return chunk && chunk->closed[index_in_chunk(index)];
+}
+
+u32 cooperative_planner::chunk_index(const u32 index) const
+{
+	const u32 x = index % width;
+	const u32 y = index / width;
+
+	return (y / chunk_size) * chunks_per_row + x / chunk_size;
+}
+
+u16 cooperative_planner::index_in_chunk(const u32 index) const
+{
+	const u32 x = index % width;
+	const u32 y = index / width;
+
+	return (y % chunk_size) * chunk_size + x % chunk_size;
+}
+
+bool cooperative_planner::plan_agent(const u32 agent_id)
+{
+	agent& a = agents[agent_id];
+
+	// the search containers are reused between agents. Clearing them keeps their
+	// capacity and the freed nodes go back to the pool, so a warmed up planner
+	// doesn't need to allocate from the heap here
+	search_nodes.clear();
+	best_g_costs.clear();
+	open_list.clear();
+
+	const auto state_key = [&](const u32 tile, const u16 time_offset) -> u64
+	{
+		return static_cast<u64>(tile) * (window_size + 1) + time_offset;
+	};
+
+	search_nodes.push_back({ a.position, 0, 0, no_node });
+	best_g_costs[state_key(a.position, 0)] = 0;
+	push_open_node(heuristic(*a.distances, a.position), 0);
+
+	u32 end_node = no_node;
+
+	while (!open_list.empty())
+	{
+		const u32 node_index = pop_open_node();
+
+		const search_node current = search_nodes[node_index];
+
+		// skip the node if a cheaper way to the same tile and time was found after it was added
+		if (best_g_costs[state_key(current.tile_index, current.time_offset)] < current.g_cost)
+			continue;
+
+		// the best node at the end of the window has been found. The heuristic
+		// already accounts for the rest of the route past the window
+		if (current.time_offset == window_size)
+		{
+			end_node = node_index;
+			break;
+		}
+
+		const u32 current_time = time + current.time_offset;
+
+		// copy the neighbors, since the heuristic also uses the neighbor scratch buffer
+		std::array<u32, max_neighbor_count> next_tiles;
+		u8 next_tile_count = 0;
+		for (tile* const t : get_tile_neighbors(current.tile_index))
+			next_tiles[next_tile_count++] = tile_index(t->coordinates);
+
+		for (u8 i = 0; i < next_tile_count; ++i)
+		{
+			const u32 next = next_tiles[i];
+
+			// skip the tile if someone else will be there at the next step
+			const u32 owner = reservations.reserved_by(next, current_time + 1);
+			if (owner != reservation_table::no_agent && owner != agent_id)
+				continue;
+
+			// don't swap places with another agent. They would have to go through each other
+			if (next != current.tile_index)
+			{
+				const u32 other = reservations.reserved_by(next, current_time);
+				if (other != reservation_table::no_agent && other != agent_id
+						&& reservations.reserved_by(current.tile_index, current_time + 1) == other)
+					continue;
+			}
+
+			// staying at the goal is free, so agents that have arrived are happy to stay there
+			const bool waiting_at_goal = (next == current.tile_index && next == a.goal);
+			const u32 new_g_cost = current.g_cost + (waiting_at_goal ? 0 : move_cost(current.tile_index, next));
+
+			const auto [it, inserted] = best_g_costs.try_emplace(state_key(next, current.time_offset + 1), new_g_cost);
+			if (!inserted)
+			{
+				if (new_g_cost >= it->second)
+					continue;
+
+				it->second = new_g_cost;
+			}
+
+			// the goal can't be reached from this tile
+			const u16 h_cost = heuristic(*a.distances, next);
+			if (h_cost == unknown_distance)
+				continue;
+
+			search_nodes.push_back({ next, static_cast<u16>(current.time_offset + 1), new_g_cost, node_index });
+			push_open_node(new_g_cost + h_cost, search_nodes.size() - 1);
+		}
+	}
+
+	// no route could be found within the window
+	if (end_node == no_node)
+		return false;
+
+	// walk back from the end of the window to get the route
+	a.route.resize(window_size + 1);
+
+	for (u32 n = end_node; n != no_node; n = search_nodes[n].predecessor)
+		a.route[search_nodes[n].time_offset] = tiles[search_nodes[n].tile_index].coordinates;
+
+	// reserve the route so that the agents planned after this one avoid it
+	// the search skips reserved tiles, so a conflict here would mean that the
+	// agent started on a tile shared with another agent
+	for (u16 i = 0; i < a.route.size(); ++i)
+		if (!reservations.reserve(tile_index(a.route[i]), time + i, agent_id))
+			++reservation_conflicts;
+
+	return true;
+}
+
+void cooperative_planner::plan_wait(const u32 agent_id)
+{
+	agent& a = agents[agent_id];
+
+	a.route.assign(window_size + 1, tiles[a.position].coordinates);
+
+	// some of the steps might already be reserved by other agents,
+	// but there's nowhere else to go. Those get counted as conflicts
+	for (u16 i = 0; i < a.route.size(); ++i)
+		if (!reservations.reserve(a.position, time + i, agent_id))
+			++reservation_conflicts;
+}
+
+void cooperative_planner::push_open_node(const u32 f_cost, const u32 node_index)
+{
+	open_list.push_back({ f_cost, node_index });
+	std::push_heap(open_list.begin(), open_list.end(), std::greater<open_node>());
+}
+
+u32 cooperative_planner::pop_open_node()
+{
+	// move the node with the lowest f_cost to the back and take it from there
+	std::pop_heap(open_list.begin(), open_list.end(), std::greater<open_node>());
+	const u32 node_index = open_list.back().second;
+	open_list.pop_back();
+
+	return node_index;
+}
+
+bool cooperative_planner::is_in_bounds(const birb::vec2<i16> coordinates) const
+{
+	return coordinates.x >= 0 && coordinates.y >= 0 && coordinates.x < width && coordinates.y < height;
+}
+
+u32 cooperative_planner::tile_index(const birb::vec2<i16> coordinates) const
+{
+	return coordinates.y * width + coordinates.x;
+}
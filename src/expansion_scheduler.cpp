@@ -0,0 +1,66 @@
+#include <algorithm>
+
+#include "ExpansionScheduler.hpp"
+
+expansion_scheduler::expansion_scheduler(const birb::timestep& timestep, const f64 target_frame_time)
+:timestep(timestep), target_frame_time(target_frame_time), smoothed_frame_time(target_frame_time)
+{}
+
+void expansion_scheduler::use_fixed_batch(const u32 expansions_per_frame)
+{
+	scheduling_mode = mode::fixed;
+
+	// always do at least some progress on every frame
+	batch = std::clamp(expansions_per_frame, min_batch_size, max_batch_size);
+}
+
+u32 expansion_scheduler::next_batch()
+{
+	// the fixed mode doesn't care about the timings
+	if (scheduling_mode == mode::fixed)
+		return batch;
+
+	// average out the frame times a bit, so that a single slow frame
+	// (a window resize for example) doesn't throw away the batch size
+	smoothed_frame_time += smoothing * (timestep.deltatime() - smoothed_frame_time);
+
+	// spend a part of the frame on the expansions. On displays faster than the target
+	// the budget follows the measured frame time, so the frame rate doesn't drop.
+	// On slow machines the target caps the budget
+	const f64 budget = expansion_budget * std::min(smoothed_frame_time, target_frame_time);
+
+	// fit as many expansions into the budget as the measurements say should fit
+	// the batch can at most halve or double per frame so that a single
+	// odd measurement doesn't cause a spike
+	if (smoothed_expansion_time > 0)
+	{
+		const f64 fitting_batch = budget / smoothed_expansion_time;
+		const f64 lower_limit = std::max(min_batch_size, batch / 2);
+		const f64 upper_limit = std::min(max_batch_size, batch * 2);
+
+		batch = static_cast<u32>(std::clamp(fitting_batch, lower_limit, upper_limit));
+	}
+
+	batch_start = std::chrono::steady_clock::now();
+	return batch;
+}
+
+void expansion_scheduler::batch_finished(const u32 expansions_run)
+{
+	// nothing to measure if no expansions were run
+	if (scheduling_mode == mode::fixed || expansions_run == 0)
+		return;
+
+	// only the time spent running the batch gets measured. Rendering and
+	// waiting for vsync don't affect how many expansions fit into the budget
+	const std::chrono::duration<f64> batch_time = std::chrono::steady_clock::now() - batch_start;
+
+	// the batch can end early when the goal is reached, so the time gets divided
+	// by the expansions that actually ran instead of the batch size
+	const f64 expansion_time = batch_time.count() / expansions_run;
+
+	if (smoothed_expansion_time == 0)
+		smoothed_expansion_time = expansion_time;
+	else
+		smoothed_expansion_time += smoothing * (expansion_time - smoothed_expansion_time);
+}
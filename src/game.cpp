@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <format>
 
 #include "Entity.hpp"
@@ -11,6 +12,7 @@
 #include "ShaderSprite.hpp"
 #include "Text.hpp"
 #include "Tile.hpp"
+#include "TileGrid.hpp"
 #include "Transform.hpp"
 #include "Transformer.hpp"
 #include "Vector.hpp"
@@ -152,50 +154,29 @@ void game::generate_map()
 	walls[current_location.y][current_location.x] = static_cast<u8>(tile_state::end);
 }
 
-std::vector<tile*> game::get_tile_neighbors(const birb::vec2<i16> tile_to_check)
+const std::pmr::vector<tile*>& game::get_tile_neighbors(const birb::vec2<i16> tile_to_check)
 {
-	// a lambda that checks if a tile is an explorable neighbor or not
-	// a not-explorable tile would be a tile out-of-bounds or an obstacle
-	const auto is_explorable_tile = [&](const birb::vec2<i16> tile_coords) -> bool
+	// the tiles are stored as pointers in a 2D array
+	const auto get_tile = [&](const birb::vec2<i16> tile_coords) -> tile*
 	{
-		// check if the tile is within the bounds of the area we are exploring
-		if (tile_coords.x < 0 || tile_coords.y < 0)
-			return false;
-
-		if (tile_coords.x >= walls.size() || tile_coords.y >= walls.size())
-			return false;
-
-		// check if the tile is an obstacle
-		if (tiles[tile_coords.y][tile_coords.x]->state == tile_state::obstacle)
-			return false;
-
-		return true;
+		return tiles[tile_coords.y][tile_coords.x];
 	};
 
-	std::vector<tile*> neighbors;
-
-	// loop through a 3x3 grid around the tile we are checking
-	for (i8 i = -1; i < 2; ++i)
-	{
-		for (i8 j = -1; j < 2; ++j)
-		{
-			// skip the current tile (that we are checking)
-			// we are at the current tile when i and j are 0
-			if (!i && !j) continue;
-
-			// check if the tile is explorable (i.e. in the bounds and not an obstacle)
-			// if it is, add it to the neighbor list
-			if (is_explorable_tile(birb::vec2<i16>(tile_to_check.x - i, tile_to_check.y - j)))
-				neighbors.emplace_back(tiles[tile_to_check.y - j][tile_to_check.x - i]);
-		}
-	}
+	// there's no waiting in place in the single agent search,
+	// so the tile itself isn't counted as a neighbor
+	find_tile_neighbors(tile_to_check, birb::vec2<i16>(map_size, map_size), get_tile, false, neighbor_scratch);
 
-	return neighbors;
+	return neighbor_scratch;
 }
 
 void game::update_weight_texts()
 {
 	// update the weight texts
+	//
+	// NOTE: this is the one part of the search loop that isn't allocation free.
+	// The text rows are passed to birb::text::set_text(), which is engine code
+	// that can copy the string and allocate for the text mesh. Its memory
+	// doesn't come from the search arena
 	for (size_t i = 0; i < weight_text_rows.size(); ++i)
 		weight_text_rows.at(i)->set_text(weight_text_row_strings.at(i));
 
@@ -203,10 +184,36 @@ void game::update_weight_texts()
 		f_and_h_cost_text_rows.at(i)->set_text(f_and_h_cost_text_row_strings.at(i));
 }
 
-void game::update()
+u32 game::update(const u32 expansion_count)
+{
+	// nothing to do anymore if the route has already been found
+	if (road_found)
+		return 0;
+
+	// progress the path finding by the requested amount of tiles
+	// the loop stops early if the goal gets reached in the middle of the batch
+	u32 expansions_run = 0;
+	while (expansions_run < expansion_count && !road_found)
+	{
+		expand_next_tile();
+		++expansions_run;
+	}
+
+	// the visuals only need to be up-to-date when the frame gets drawn,
+	// so they are refreshed only once per batch
+	update_tile_visuals();
+
+	// if the goal was reached, color the route on top of the open and closed tiles
+	if (road_found)
+		show_route();
+
+	return expansions_run;
+}
+
+void game::expand_next_tile()
 {
-	// treat the update as a while loop
-	// its called on every frame from the main loop at main.cpp
+	// treat this function as the body of the A* while loop
+	// update() calls it as many times per frame as the scheduler in main.cpp allows
 
 	// pick a tile from the open_set that has the lowest f_cost
 	// and set it to be the new current tile
@@ -231,9 +238,6 @@ void game::update()
 	// from start to finish
 	if (current_tile == end_location)
 	{
-		if (road_found)
-			return;
-
 		road_found = true;
 
 		// start from the end tile and work towards the start tile
@@ -248,26 +252,8 @@ void game::update()
 		// also mark the start tile as part of the route
 		tiles[start_location.y][start_location.x]->state = tile_state::route;
 
-		// find all entities that have a tile and shader_sprite component on them
-		const auto tile_view = scene.registry.view<tile, birb::shader_sprite>();
-
-		// loop through the entities
-		for (const auto tile_entity : tile_view)
-		{
-			// get the tile and shader_sprite components from the entity
-			const tile& t = tile_view.get<tile>(tile_entity);
-			birb::shader_sprite& s = tile_view.get<birb::shader_sprite>(tile_entity);
-
-			// if the tile is not part of the route, skip it
-			if (t.state != tile_state::route)
-				continue;
-
-			// set the shader of the tile to the route shader
-			s.set_shader(s_route);
-		}
-
-		// don't do any further processing since we have found
-		// and visualized the route to the goal
+		// don't do any further processing since we have found the route
+		// to the goal. The route gets visualized at the end of update()
 		return;
 	}
 
@@ -276,7 +262,7 @@ void game::update()
 	closed_set.insert(current_tile_ptr);
 
 	// get neighbors of the current tile
-	const std::vector<tile*> current_tile_neighbors = get_tile_neighbors(current_tile);
+	const std::pmr::vector<tile*>& current_tile_neighbors = get_tile_neighbors(current_tile);
 	birb::ensure(!current_tile_neighbors.empty(), "coudln't find any neighbors for the current tile");
 
 	// update the g_costs and h_costs of the neighbors and set
@@ -308,7 +294,10 @@ void game::update()
 			open_set.insert(t);
 		}
 	}
+}
 
+void game::update_tile_visuals()
+{
 	// set tile colors and weight texts based on if they are in the sets or not
 	// this could probably be optimized further to avoid unnecessary
 	// shader switching
@@ -340,11 +329,10 @@ void game::update()
 			// calculate the number position in the row
 			const size_t num_pos = t->coordinates.x * 4;
 
-			// update the value
-			const std::string weight_str = std::format("{:03}", t->f_cost());
-
-			for (u8 i = 0; i < weight_str.size(); ++i)
-				text_row.at(num_pos + i) = weight_str.at(i);
+			// update the value in place to avoid creating temporary strings
+			// the value gets clamped, so that it always fits into its 3 characters
+			birb::ensure(num_pos + 3 <= text_row.size());
+			std::format_to(text_row.begin() + num_pos, "{:03}", std::min(t->f_cost(), max_displayed_cost));
 		}
 
 		// h_cost and f_cost
@@ -355,11 +343,11 @@ void game::update()
 			// calculate the number position in the row
 			const size_t num_pos = t->coordinates.x * 8;
 
-			// update the value
-			const std::string weight_str = std::format("{:03} {:03} ", t->g_cost, t->h_cost);
-
-			for (u8 i = 0; i < weight_str.size(); ++i)
-				text_row.at(num_pos + i) = weight_str.at(i);
+			// update the values in place to avoid creating temporary strings
+			// the values get clamped, so that they always fit into their 3 characters
+			birb::ensure(num_pos + 8 <= text_row.size());
+			std::format_to(text_row.begin() + num_pos, "{:03} {:03} ",
+					std::min(t->g_cost, max_displayed_cost), std::min(t->h_cost, max_displayed_cost));
 		}
 	}
 
@@ -367,6 +355,27 @@ void game::update()
 	update_weight_texts();
 }
 
+void game::show_route()
+{
+	// find all entities that have a tile and shader_sprite component on them
+	const auto tile_view = scene.registry.view<tile, birb::shader_sprite>();
+
+	// loop through the entities
+	for (const auto tile_entity : tile_view)
+	{
+		// get the tile and shader_sprite components from the entity
+		const tile& t = tile_view.get<tile>(tile_entity);
+		birb::shader_sprite& s = tile_view.get<birb::shader_sprite>(tile_entity);
+
+		// if the tile is not part of the route, skip it
+		if (t.state != tile_state::route)
+			continue;
+
+		// set the shader of the tile to the route shader
+		s.set_shader(s_route);
+	}
+}
+
 void game::reset()
 {
 	road_found = false;
@@ -374,9 +383,8 @@ void game::reset()
 	// generate a new map
 	generate_map();
 
-	// clear the sets
-	closed_set.clear();
-	open_set.clear();
+	// clear the sets and rewind the search arena
+	reset_search_memory();
 
 	// add the starting tile to the open_set
 	open_set.insert(tiles[start_location.y][start_location.x]);
@@ -419,26 +427,36 @@ void game::reset()
 
 	// reset weight texts
 
-	// generate a default text strings full of whitespace
-	std::string g_text = "";
-	std::string fh_text = "";
-
-	for (i16 i = 0; i < walls.size(); ++i)
-	{
-		g_text += "    ";
-		fh_text += "        ";
-	}
-
+	// fill the text strings with whitespace
+	// assign() reuses the existing capacity after the first reset
 	for (std::string& row : weight_text_row_strings)
-		row = g_text;
+		row.assign(walls.size() * 4, ' ');
 
 	for (std::string& row : f_and_h_cost_text_row_strings)
-		row = fh_text;
+		row.assign(walls.size() * 8, ' ');
 
 	// update text entities
 	update_weight_texts();
 }
 
+void game::reset_search_memory()
+{
+	// swap the containers with empty ones so that they don't point to the arena
+	// anymore when it gets released. Default constructed unordered_sets don't
+	// allocate anything, so the swaps are free
+	std::pmr::unordered_set<tile*>(&search_arena).swap(open_set);
+	std::pmr::unordered_set<tile*>(&search_arena).swap(closed_set);
+	std::pmr::vector<tile*>(&search_arena).swap(neighbor_scratch);
+
+	// rewind the arena back to the start of the buffer
+	search_arena.release();
+
+	// pre-size the containers so that they don't need to rehash or grow during the search
+	open_set.reserve(map_size * map_size);
+	closed_set.reserve(map_size * map_size);
+	neighbor_scratch.reserve(max_neighbor_count);
+}
+
 bool game::is_done() const
 {
 	return road_found;
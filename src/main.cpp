@@ -1,3 +1,7 @@
+#include <charconv>
+#include <iostream>
+#include <string_view>
+
 #include "Camera.hpp"
 #include "CameraInfoOverlay.hpp"
 #include "PerformanceOverlay.hpp"
@@ -8,10 +12,35 @@
 #include "Timestep.hpp"
 #include "Window.hpp"
 
+#include "ExpansionScheduler.hpp"
 #include "Game.hpp"
 
-int main(void)
+int main(int argc, char** argv)
 {
+	// parse the command line arguments
+	//
+	// --fixed <n> runs n pathfinding iterations per frame instead of fitting
+	// as many iterations into each frame as the frame time allows.
+	// Useful for recording videos that look the same every time
+	u32 fixed_batch_size{0};
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string_view arg = argv[i];
+
+		if (arg == "--fixed" && i + 1 < argc)
+		{
+			const std::string_view value = argv[++i];
+			const auto [ptr, error] = std::from_chars(value.data(), value.data() + value.size(), fixed_batch_size);
+
+			if (error == std::errc() && ptr == value.data() + value.size() && fixed_batch_size > 0)
+				continue;
+		}
+
+		std::cerr << "usage: " << argv[0] << " [--fixed <iterations per frame>]\n";
+		return 1;
+	}
+
 	// tell the shader class where to look for custom shaders
 	birb::shader::shader_src_search_paths.push_back("assets/shaders");
 
@@ -36,7 +65,13 @@ int main(void)
 	// create the game state
 	game game;
 
-	birb::timer pathfinder_tick_timer(0.1);
+	// decides how many pathfinding iterations get run per frame
+	// by default the iterations get a part of each frame, capped by the 60fps frame time.
+	// The --fixed argument switches to a fixed amount of iterations per frame
+	expansion_scheduler pathfinder_scheduler(timestep, 1.0 / 60.0);
+
+	if (fixed_batch_size)
+		pathfinder_scheduler.use_fixed_batch(fixed_batch_size);
 
 	birb::timer new_map_timer(1.0);
 	bool waiting_for_new_map{false};
@@ -80,19 +115,14 @@ int main(void)
 
 		// progress timers
 		if (!paused)
-		{
-			pathfinder_tick_timer.tick(timestep.deltatime());
 			new_map_timer.tick(timestep.deltatime());
-		}
 
 		// update the game state (path finding)
-		if (pathfinder_tick_timer.done())
+		if (!paused && !game.is_done())
 		{
-			// progress the path finding
-			game.update();
-
-			// reset the pathfinding timer
-			pathfinder_tick_timer.reset();
+			// progress the path finding by as many iterations as the scheduler allows
+			const u32 expansions_run = game.update(pathfinder_scheduler.next_batch());
+			pathfinder_scheduler.batch_finished(expansions_run);
 
 			// if the path was found, start waiting for a map reset
 			if (game.is_done() && !waiting_for_new_map)
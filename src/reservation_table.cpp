@@ -0,0 +1,105 @@
+#include <bit>
+
+#include "ReservationTable.hpp"
+
+reservation_table::reservation_table(const size_t max_reservations)
+{
+	// keep the table at most half full so that the probe sequences stay short
+	// the capacity needs to be a power of two for the index masking to work
+	capacity = std::bit_ceil(std::max<size_t>(max_reservations * 2, 16));
+	slots = std::make_unique<slot[]>(capacity);
+}
+
+bool reservation_table::reserve(const u32 tile_index, const u32 time, const u32 agent)
+{
+	const u64 key = make_key(tile_index, time);
+
+	// walk the probe sequence until we find the key or a free slot
+	// slots from older generations count as free
+	size_t index = slot_index(key);
+	for (size_t i = 0; i < capacity; ++i)
+	{
+		slot& s = slots[index];
+		const u64 slot_key = s.key.load(std::memory_order_relaxed);
+
+		// the tile has already been reserved at this time
+		if (slot_key == key)
+			return s.agent.load(std::memory_order_relaxed) == agent;
+
+		// claim the free slot. The agent needs to be written before the key
+		// so that readers that see the key will also see the agent
+		if ((slot_key >> (tile_bits + time_bits)) != generation)
+		{
+			s.agent.store(agent, std::memory_order_relaxed);
+			s.key.store(key, std::memory_order_release);
+			return true;
+		}
+
+		index = (index + 1) & (capacity - 1);
+	}
+
+	// the table is full
+	return false;
+}
+
+u32 reservation_table::reserved_by(const u32 tile_index, const u32 time) const
+{
+	const u64 key = make_key(tile_index, time);
+
+	size_t index = slot_index(key);
+	for (size_t i = 0; i < capacity; ++i)
+	{
+		const slot& s = slots[index];
+		const u64 slot_key = s.key.load(std::memory_order_acquire);
+
+		if (slot_key == key)
+			return s.agent.load(std::memory_order_relaxed);
+
+		// hitting a free slot means that the key isn't in the table
+		if ((slot_key >> (tile_bits + time_bits)) != generation)
+			return no_agent;
+
+		index = (index + 1) & (capacity - 1);
+	}
+
+	return no_agent;
+}
+
+void reservation_table::clear()
+{
+	// bumping the generation makes all of the old keys look like free slots
+	if (++generation != 0)
+		return;
+
+	// the generation counter wrapped around, so old keys could start matching
+	// the new generations. Wipe the table and start over from the first generation
+	for (size_t i = 0; i < capacity; ++i)
+	{
+		slots[i].key.store(0, std::memory_order_relaxed);
+		slots[i].agent.store(no_agent, std::memory_order_relaxed);
+	}
+
+	generation = 1;
+}
+
+u64 reservation_table::make_key(const u32 tile_index, const u32 time) const
+{
+	// the time step wraps around after 2^24 steps, which is way longer
+	// than any reservation window
+	constexpr u64 tile_mask = (1ull << tile_bits) - 1;
+	constexpr u64 time_mask = (1ull << time_bits) - 1;
+
+	return (static_cast<u64>(generation) << (tile_bits + time_bits))
+		| ((time & time_mask) << tile_bits)
+		| (tile_index & tile_mask);
+}
+
+size_t reservation_table::slot_index(const u64 key) const
+{
+	// fibonacci hashing spreads the neighboring tiles and time steps around the table
+	// the generation is left out so that the slot doesn't depend on it
+	constexpr u64 generation_mask = (1ull << (tile_bits + time_bits)) - 1;
+	const u64 hash = (key & generation_mask) * 0x9E3779B97F4A7C15ull;
+
+	return static_cast<size_t>(hash >> (64 - std::countr_zero(capacity)));
+}